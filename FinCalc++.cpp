@@ -1,180 +1,7 @@
+// Demonstration program for the header-only FinCalc++ library.
+#include "FinCalc++.hpp"
 #include <iostream> 
-#include <cmath>    
-#include <vector>   
 #include <iomanip>  
-#include <limits>   
-
-
-namespace FinancialLibrary {
-
-    /**
-     * @brief Calculates the Future Value (FV) of a single cash flow.
-     *
-     * The future value is the value of a current asset at a future date based on
-     * an assumed rate of growth.
-     *
-     * Formula: FV = PV * (1 + r)^n
-     *
-     * @param present_value The current value of the investment or cash flow.
-     * @param annual_interest_rate The annual interest rate (e.g., 0.05 for 5%).
-     * @param number_of_periods The number of periods (e.g., years) over which the investment grows.
-     * @return The future value of the investment.
-     */
-    double calculateFutureValue(double present_value, double annual_interest_rate, int number_of_periods) {
-        if (number_of_periods < 0) {
-            std::cerr << "Error: Number of periods cannot be negative for Future Value calculation.\n";
-            return 0.0; // Return 0 or throw an exception for invalid input
-        }
-        return present_value * std::pow((1.0 + annual_interest_rate), number_of_periods);
-    }
-
-    /**
-     * @brief Calculates the Present Value (PV) of a single future cash flow.
-     *
-     * The present value is the current value of a future sum of money or stream of cash flows
-     * given a specified rate of return.
-     *
-     * Formula: PV = FV / (1 + r)^n
-     *
-     * @param future_value 
-     * @param annual_discount_rate .
-     * @param number_of_periods 
-     * @return 
-     */
-    double calculatePresentValue(double future_value, double annual_discount_rate, int number_of_periods) {
-        if (number_of_periods < 0) {
-            std::cerr << "Error: Number of periods cannot be negative for Present Value calculation.\n";
-            return 0.0; // Return 0 or throw an exception for invalid input
-        }
-        if (annual_discount_rate <= -1.0) { // To prevent division by zero or negative base for power
-            std::cerr << "Error: Discount rate must be greater than -100%.\n";
-            return 0.0;
-        }
-        return future_value / std::pow((1.0 + annual_discount_rate), number_of_periods);
-    }
-
-    /**
-     * @brief Calculates the Net Present Value (NPV) of a series of cash flows.
-     *
-     * NPV is the difference between the present value of cash inflows and the present value
-     * of cash outflows over a period of time.
-     *
-     * Formula: NPV = Sum[CFt / (1 + r)^t] - Initial_Investment
-     * where CFt is the cash flow at time t, r is the discount rate, and t is the period.
-     *
-     * @param discount_rate The discount rate (e.g., 0.10 for 10%).
-     * @param cash_flows A vector of cash flows. The first element (index 0) is typically
-     * the initial investment (a negative value), followed by positive inflows.
-     * @return The Net Present Value.
-     */
-    double calculateNetPresentValue(double discount_rate, const std::vector<double>& cash_flows) {
-        double npv = 0.0;
-        if (discount_rate <= -1.0) {
-            std::cerr << "Error: Discount rate must be greater than -100% for NPV calculation.\n";
-            return std::numeric_limits<double>::quiet_NaN(); // Return NaN for invalid rate
-        }
-
-        for (size_t t = 0; t < cash_flows.size(); ++t) {
-            // The first cash flow (index 0) is often the initial investment,
-            // which is not discounted (t=0). Subsequent cash flows are discounted.
-            npv += cash_flows[t] / std::pow((1.0 + discount_rate), t);
-        }
-        return npv;
-    }
-
-    /**
-     * @brief Calculates simple interest.
-     *
-     * Simple interest is calculated only on the principal amount, or on that portion
-     * of the principal amount that remains unpaid.
-     *
-     * Formula: Simple Interest = P * r * t
-     *
-     * @param principal The initial amount of money (principal).
-     * @param annual_interest_rate The annual interest rate (e.g., 0.05 for 5%).
-     * @param time_in_years The time period in years.
-     * @return The calculated simple interest.
-     */
-    double calculateSimpleInterest(double principal, double annual_interest_rate, double time_in_years) {
-        if (principal < 0 || annual_interest_rate < 0 || time_in_years < 0) {
-            std::cerr << "Error: Principal, interest rate, and time cannot be negative for Simple Interest.\n";
-            return 0.0;
-        }
-        return principal * annual_interest_rate * time_in_years;
-    }
- calculateCompoundInterest(double principal, double annual_interest_rate, int compounding_frequency, double time_in_years) {
-        if (principal < 0 || annual_interest_rate < 0 || compounding_frequency <= 0 || time_in_years < 0) {
-            std::cerr << "Error: Invalid input for Compound Interest calculation. Check principal, rate, frequency, and time.\n";
-            return 0.0;
-        }
-        return principal * std::pow((1.0 + annual_interest_rate / compounding_frequency), (compounding_frequency * time_in_years));
-    }
-
-    /**
-     * @brief Calculates the Internal Rate of Return (IRR) for a series of cash flows.
-     *
-     * IRR is the discount rate that makes the Net Present Value (NPV) of all cash flows
-     * (both inflows and outflows) from a particular project or investment equal to zero.
-     * This implementation uses a numerical approximation method (Newton-Raphson or bisection
-     * could be more robust, but a simple iterative approach is shown here).
-     *
-     * @param cash_flows A vector of cash flows. The first element (index 0) is typically
-     * the initial investment (a negative value), followed by positive inflows.
-     * @param guess An initial guess for the IRR (optional, default 0.1).
-     * @param tolerance The desired precision for the IRR (optional, default 1e-6).
-     * @param max_iterations The maximum number of iterations for the approximation (optional, default 1000).
-     * @return The calculated IRR, or NaN if convergence is not achieved or inputs are invalid.
-     */
-    double calculateInternalRateOfReturn(const std::vector<double>& cash_flows, double guess = 0.1, double tolerance = 1e-6, int max_iterations = 1000) {
-        if (cash_flows.empty()) {
-            std::cerr << "Error: Cash flow vector cannot be empty for IRR calculation.\n";
-            return std::numeric_limits<double>::quiet_NaN();
-        }
-
-        // Check if there's at least one negative and one positive cash flow for a valid IRR
-        bool has_negative = false;
-        bool has_positive = false;
-        for (double cf : cash_flows) {
-            if (cf < 0) has_negative = true;
-            if (cf > 0) has_positive = true;
-        }
-        if (!has_negative || !has_positive) {
-            std::cerr << "Warning: IRR requires at least one negative and one positive cash flow.\n";
-            return std::numeric_limits<double>::quiet_NaN();
-        }
-
-        double irr = guess;
-        for (int i = 0; i < max_iterations; ++i) {
-            double npv = 0.0;
-            double derivative_npv = 0.0; // Derivative of NPV with respect to IRR (for Newton-Raphson like step)
-
-            for (size_t t = 0; t < cash_flows.size(); ++t) {
-                double denominator = std::pow((1.0 + irr), t);
-                if (denominator == 0) { // Avoid division by zero if irr makes (1+irr) zero
-                     std::cerr << "Error: Division by zero encountered during IRR calculation. Try a different guess.\n";
-                     return std::numeric_limits<double>::quiet_NaN();
-                }
-                npv += cash_flows[t] / denominator;
-                derivative_npv -= (double)t * cash_flows[t] / std::pow((1.0 + irr), t + 1);
-            }
-
-            if (std::abs(npv) < tolerance) {
-                return irr; // IRR found within tolerance
-            }
-
-            if (derivative_npv == 0) {
-                std::cerr << "Warning: Derivative is zero during IRR calculation. Cannot converge.\n";
-                return std::numeric_limits<double>::quiet_NaN();
-            }
-
-            irr = irr - npv / derivative_npv; // Newton-Raphson step
-        }
-
-        std::cerr << "Warning: IRR did not converge within " << max_iterations << " iterations.\n";
-        return std::numeric_limits<double>::quiet_NaN(); // Return NaN if not converged
-    }
-
-} // namespace FinancialLibrary
 
 // --- Main function to demonstrate the Financial Library ---
 int main() {
@@ -205,6 +32,19 @@ int main() {
     std::cout << "  Periods: " << periods_pv << " years\n";
     std::cout << "  Calculated PV: $" << pv << "\n\n";
 
+    // --- Annuity Examples (closed form) ---
+    double annuity_payment = 500.0;
+    double annuity_rate = 0.04;
+    int annuity_periods = 20;
+    std::cout << "Annuities:\n";
+    std::cout << "  PV of $" << annuity_payment << " for " << annuity_periods << " periods at 4% (ordinary): $"
+              << FinancialLibrary::calculatePresentValueOfAnnuity(annuity_payment, annuity_rate, annuity_periods) << "\n";
+    std::cout << "  PV (annuity-due): $" << FinancialLibrary::calculatePresentValueOfAnnuityDue(annuity_payment, annuity_rate, annuity_periods) << "\n";
+    std::cout << "  FV (ordinary): $" << FinancialLibrary::calculateFutureValueOfAnnuity(annuity_payment, annuity_rate, annuity_periods) << "\n";
+    std::cout << "  PV growing 2% per period: $"
+              << FinancialLibrary::calculatePresentValueOfGrowingAnnuity(annuity_payment, annuity_rate, 0.02, annuity_periods) << "\n";
+    std::cout << "  PV of perpetuity: $" << FinancialLibrary::calculatePresentValueOfPerpetuity(annuity_payment, annuity_rate) << "\n\n";
+
     // --- Net Present Value (NPV) Example ---
     // Initial investment (outflow) is negative, subsequent cash flows are inflows.
     std::vector<double> cash_flows_npv = {-10000.0, 3000.0, 4000.0, 5000.0, 3000.0};
@@ -223,6 +63,59 @@ int main() {
         std::cout << "  NPV calculation failed.\n\n";
     }
 
+    // --- Batch NPV Example (rate sensitivity) ---
+    std::vector<double> discount_rates_batch = {0.00, 0.05, 0.10, 0.15, 0.20};
+    std::vector<double> npvs_batch = FinancialLibrary::calculateNetPresentValueBatch(discount_rates_batch, cash_flows_npv);
+    std::cout << "Net Present Value (NPV) - Rate Sensitivity:\n";
+    for (size_t i = 0; i < discount_rates_batch.size(); ++i) {
+        std::cout << "  Rate " << discount_rates_batch[i] * 100 << "%: $" << npvs_batch[i] << "\n";
+    }
+    std::cout << "\n";
+
+
+    // --- Rate Sensitivity Example (one pass for NPV, duration, convexity and DV01) ---
+    // A 5-year, 6% annual-coupon bond with face value 100, priced at an 8% yield
+    std::vector<double> bond_cash_flows = {0.0, 6.0, 6.0, 6.0, 6.0, 106.0};
+    FinancialLibrary::RateSensitivity risk = FinancialLibrary::calculateRateSensitivity(0.08, bond_cash_flows);
+    std::cout << "Bond Price and Rate Sensitivity (analytic):\n";
+    std::cout << "  Price: $" << risk.npv << "\n";
+    std::cout << "  Macaulay Duration: " << risk.macaulay_duration << " periods\n";
+    std::cout << "  Modified Duration: " << risk.modified_duration << " periods\n";
+    std::cout << "  Convexity: " << risk.convexity << "\n";
+    std::cout << "  DV01: $" << risk.dv01 << "\n\n";
+
+    // --- Streaming NPV Example (cash flows arriving one period at a time) ---
+    FinancialLibrary::NpvAccumulator npv_stream(discount_rate_npv);
+    std::cout << "Net Present Value (NPV) - Streaming:\n";
+    for (size_t i = 0; i < cash_flows_npv.size(); ++i) {
+        npv_stream.append(cash_flows_npv[i]);
+        std::cout << "  After period " << i << ": $" << npv_stream.netPresentValue() << "\n";
+    }
+    std::cout << "  dNPV/dr: $" << npv_stream.derivativeNetPresentValue() << "\n\n";
+
+    // --- Yield Curve Example (term-structure discounting) ---
+    FinancialLibrary::YieldCurve zero_curve({1.0, 2.0, 4.0}, {0.04, 0.06, 0.08}, cash_flows_npv.size());
+    std::cout << "Net Present Value (NPV) - Yield Curve:\n";
+    std::cout << "  Zero rate at period 3: " << zero_curve.zeroRate(3.0) * 100 << "%\n";
+    std::cout << "  Calculated NPV: $" << FinancialLibrary::calculateNetPresentValue(zero_curve, cash_flows_npv) << "\n\n";
+
+    // --- Dated Cash Flows Example (XNPV / XIRR, ACT/365 fixed) ---
+    std::vector<FinancialLibrary::Date> dates_x = {{2008, 1, 1}, {2008, 3, 1}, {2008, 10, 30}, {2009, 2, 15}, {2009, 4, 1}};
+    std::vector<double> cash_flows_x = {-10000.0, 2750.0, 4250.0, 3250.0, 2750.0};
+    FinancialLibrary::YearFractionTable fractions_x(dates_x, FinancialLibrary::DayCount::Actual365Fixed); // Reused by both calls
+    std::cout << "Dated Cash Flows (XNPV / XIRR):\n";
+    std::cout << "  Last flow at " << std::setprecision(4) << fractions_x.fraction(4) << std::setprecision(2) << " years\n";
+    std::cout << "  XNPV at 9%: $" << FinancialLibrary::calculateNetPresentValue(0.09, fractions_x, cash_flows_x) << "\n";
+    std::cout << "  XIRR: " << FinancialLibrary::calculateInternalRateOfReturn(fractions_x, cash_flows_x) * 100 << "%\n\n";
+
+    // --- Fixed-point Money and float Examples (settlement and screening) ---
+    std::vector<FinancialLibrary::Money> amounts_npv;
+    for (size_t i = 0; i < cash_flows_npv.size(); ++i) amounts_npv.push_back(FinancialLibrary::Money::fromDouble(cash_flows_npv[i]));
+    std::vector<float> screening_npv(cash_flows_npv.begin(), cash_flows_npv.end());
+    std::cout << "Net Present Value (NPV) - Money and float:\n";
+    std::cout << "  Money NPV (each discounted flow rounded to 0.0001): $"
+              << FinancialLibrary::calculateNetPresentValue(discount_rate_npv, amounts_npv) << "\n";
+    std::cout << "  float NPV: $" << FinancialLibrary::calculateNetPresentValue(discount_rate_npv, screening_npv) << "\n\n";
 
     // --- Simple Interest Example ---
     double principal_si = 5000.0;
@@ -246,7 +139,32 @@ int main() {
     std::cout << "  Annual Rate: " << rate_ci * 100 << "%\n";
     std::cout << "  Compounding Frequency: " << compounding_freq_ci << " (monthly)\n";
     std::cout << "  Time: " << time_ci << " years\n";
-    std::cout << "  Calculated Total Amount: $" << compound_amount << "\n\n";
+    std::cout << "  Calculated Total Amount: $" << compound_amount << "\n";
+    std::cout << "  Continuously Compounded: $"
+              << FinancialLibrary::calculateContinuousCompoundInterest(principal_ci, rate_ci, time_ci) << "\n\n";
+
+    // --- Loan Amortization Example ---
+    double loan_principal = 20000.0;
+    double loan_rate = 0.06 / 12; // 6% annual, paid monthly
+    const int loan_periods = 12;
+    double loan_payment[loan_periods], loan_interest[loan_periods], loan_repaid[loan_periods], loan_balance[loan_periods];
+    FinancialLibrary::AmortizationSchedule loan_schedule = {loan_payment, loan_interest, loan_repaid, loan_balance, 1};
+    FinancialLibrary::generateAmortizationSchedule(loan_principal, loan_rate, loan_periods, loan_schedule);
+    std::cout << "Loan Amortization:\n";
+    std::cout << "  Principal: $" << loan_principal << " over " << loan_periods << " months at 6%\n";
+    for (int k = 0; k < 3; ++k) {
+        std::cout << "  Month " << k + 1 << ": payment $" << loan_payment[k] << ", interest $" << loan_interest[k]
+                  << ", principal $" << loan_repaid[k] << ", balance $" << loan_balance[k] << "\n";
+    }
+    std::cout << "  Balance after 6 months (closed form): $"
+              << FinancialLibrary::calculateLoanBalance(loan_principal, loan_rate, loan_periods, 6) << "\n\n";
+
+    // --- Compile-time Compounding Example ---
+    constexpr double monthly_growth = FinancialLibrary::compoundingFactor(0.07, 12, 60); // folded by the compiler
+    constexpr double fv_constexpr = FinancialLibrary::calculateFutureValue(1000.0, 0.05, 10);
+    std::cout << "Compile-time Compounding:\n";
+    std::cout << "  Growth factor, 7% monthly for 5 years: " << std::setprecision(6) << monthly_growth << std::setprecision(2) << "\n";
+    std::cout << "  FV of $1000.00 at 5% for 10 years: $" << fv_constexpr << "\n\n";
 
     // --- Internal Rate of Return (IRR) Example ---
     // Cash flows: Initial investment of -1000, then inflows of 300, 400, 500, 600
@@ -264,6 +182,14 @@ int main() {
         std::cout << "  IRR calculation failed or did not converge.\n\n";
     }
 
+    // --- IRR Solver Telemetry Example ---
+    FinancialLibrary::IrrSolveResult irr_solve = FinancialLibrary::solveInternalRateOfReturn(cash_flows_irr);
+    std::cout << "Internal Rate of Return (IRR) - Solver Telemetry:\n";
+    std::cout << "  Iterations: " << irr_solve.iterations << "\n";
+    std::cout << "  Method: " << (irr_solve.method == FinancialLibrary::IrrMethod::Brent ? "Brent" :
+                                  irr_solve.method == FinancialLibrary::IrrMethod::Newton ? "Newton-Raphson" : "none") << "\n";
+    std::cout << std::scientific << "  Final |NPV|: " << irr_solve.residual << std::fixed << "\n\n";
+
     // --- IRR Example with no convergence (or invalid cash flows) ---
     std::vector<double> cash_flows_irr_no_conv = {-1000.0, -200.0, -50.0}; // All negative cash flows
     double irr_no_conv = FinancialLibrary::calculateInternalRateOfReturn(cash_flows_irr_no_conv);
@@ -279,6 +205,28 @@ int main() {
         std::cout << "  IRR calculation failed or did not converge (expected).\n\n";
     }
 
+    // --- Multiple IRRs and MIRR Example (non-conventional cash flows) ---
+    std::vector<double> cash_flows_mirr = {-100.0, 230.0, -132.0}; // Two sign changes: IRRs of 10% and 20%
+    FinancialLibrary::IrrRoots irr_roots = FinancialLibrary::findInternalRatesOfReturn(cash_flows_mirr);
+    std::cout << "Internal Rate of Return (IRR) - All Roots:\n";
+    std::cout << "  Sign changes: " << irr_roots.sign_changes << "\n";
+    for (size_t i = 0; i < irr_roots.irrs.size(); ++i) {
+        std::cout << "  IRR " << i + 1 << ": " << irr_roots.irrs[i] * 100 << "%\n";
+    }
+    std::cout << "  MIRR (finance 8%, reinvestment 10%): "
+              << FinancialLibrary::calculateModifiedInternalRateOfReturn(cash_flows_mirr, 0.08, 0.10) * 100 << "%\n\n";
+
+    // --- Asynchronous Batch Example (future with a deadline) ---
+    FinancialLibrary::AsyncEvaluator async_evaluator;
+    std::future<FinancialLibrary::Result<std::vector<double> > > async_irrs = async_evaluator.submitInternalRateOfReturnBatch(
+        {cash_flows_irr, cash_flows_npv}, FinancialLibrary::CancellationToken(),
+        std::chrono::steady_clock::now() + std::chrono::seconds(1));
+    // ... the submitting thread is free for I/O here ...
+    FinancialLibrary::Result<std::vector<double> > async_result = async_irrs.get();
+    std::cout << "Asynchronous IRR Batch:\n";
+    std::cout << "  Status: " << FinancialLibrary::errorCodeName(async_result.error()) << "\n";
+    std::cout << "  IRRs: " << async_result.value()[0] * 100 << "%, " << async_result.value()[1] * 100 << "%\n\n";
+
 
     return 0;
 }
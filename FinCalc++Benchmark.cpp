@@ -0,0 +1,348 @@
+// Micro-benchmarks for the FinCalc++ library.
+//
+// Build and run:
+//   g++ FinCalc++Benchmark.cpp -o fincalc_bench -std=c++11 -O2 -pthread
+//   ./fincalc_bench                      (table on stdout)
+//   ./fincalc_bench --json > bench.json  (Google Benchmark style JSON)
+//   ./fincalc_bench --min-time=0.5       (seconds per benchmark, default 0.1)
+//
+// The JSON layout follows Google Benchmark's ("context" plus a "benchmarks" array with
+// name, iterations, real_time, cpu_time and time_unit), so its compare.py tooling can
+// diff two runs. IRR benchmarks add "solver_iterations", the NPV evaluations per solve.
+#include "FinCalc++.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+
+namespace {
+
+    struct BenchmarkResult {
+        std::string name;
+        unsigned long long iterations;
+        double ns_per_op;
+        double solver_iterations; // < 0 when not applicable
+    };
+
+    volatile double benchmark_sink = 0.0; // Keeps results observable so calls are not optimized away
+
+    /**
+     * @brief Times op() in growing batches until a batch takes at least min_seconds.
+     */
+    template <typename Op>
+    BenchmarkResult runBenchmark(const std::string& name, double min_seconds, Op op, double solver_iterations = -1.0) {
+        typedef std::chrono::steady_clock Clock;
+        unsigned long long iterations = 1;
+        for (;;) {
+            double sink = 0.0;
+            const Clock::time_point start = Clock::now();
+            for (unsigned long long i = 0; i < iterations; ++i) {
+                sink += op(i);
+            }
+            const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            benchmark_sink = sink;
+            if (seconds >= min_seconds || iterations >= (1ULL << 40)) {
+                BenchmarkResult result = {name, iterations, seconds * 1e9 / double(iterations), solver_iterations};
+                return result;
+            }
+            // Aim slightly past min_seconds, growing by at most 10x per round
+            const double scale = seconds > 0 ? 1.4 * min_seconds / seconds : 10.0;
+            iterations = (unsigned long long)(double(iterations) * std::min(std::max(scale, 2.0), 10.0));
+        }
+    }
+
+    /**
+     * @brief A conventional project: one outflow followed by level inflows with a mild deterministic wobble.
+     */
+    std::vector<double> conventionalCashFlows(size_t periods) {
+        std::vector<double> cash_flows(periods);
+        cash_flows[0] = -100.0 * double(periods) * 0.6;
+        for (size_t t = 1; t < periods; ++t) {
+            cash_flows[t] = 100.0 + 25.0 * std::sin(0.7 * double(t));
+        }
+        return cash_flows;
+    }
+
+    /**
+     * @brief Heavy loss: inflows return about 1% of the outlay, putting the IRR near -90% where NPV is steep.
+     */
+    std::vector<double> slowConvergenceCashFlows(size_t periods) {
+        std::vector<double> cash_flows(periods, 0.01);
+        cash_flows[0] = -100.0 * double(periods);
+        return cash_flows;
+    }
+
+    /**
+     * @brief Outflows and inflows alternating in blocks, so NPV changes sign several times.
+     */
+    std::vector<double> multipleSignChangeCashFlows(size_t periods) {
+        std::vector<double> cash_flows(periods);
+        for (size_t t = 0; t < periods; ++t) {
+            cash_flows[t] = ((t / 3) % 2 == 0 ? -100.0 : 110.0) + double(t % 3);
+        }
+        return cash_flows;
+    }
+
+    /**
+     * @brief IRR far from the default guess of 10%: a quick payback worth roughly +300% per period.
+     */
+    std::vector<double> distantRootCashFlows(size_t periods) {
+        std::vector<double> cash_flows(periods, 50.0);
+        cash_flows[0] = -15.0;
+        return cash_flows;
+    }
+
+    void printTable(const std::vector<BenchmarkResult>& results) {
+        std::printf("%-56s %16s %14s %14s\n", "Benchmark", "Iterations", "ns/op", "Evals/solve");
+        for (size_t i = 0; i < results.size(); ++i) {
+            const BenchmarkResult& r = results[i];
+            std::printf("%-56s %16llu %14.1f", r.name.c_str(), r.iterations, r.ns_per_op);
+            if (r.solver_iterations >= 0) {
+                std::printf(" %14.1f", r.solver_iterations);
+            }
+            std::printf("\n");
+        }
+    }
+
+    void printJson(const std::vector<BenchmarkResult>& results, double min_seconds) {
+        char date[64];
+        const std::time_t now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+        std::printf("{\n  \"context\": {\n");
+        std::printf("    \"date\": \"%s\",\n", date);
+        std::printf("    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+        std::printf("    \"min_time\": %g,\n", min_seconds);
+        std::printf("    \"library_build_type\": \"%s\"\n", FinancialLibrary::detectSimdLevel() == FinancialLibrary::SimdLevel::AVX512 ? "avx512" :
+                                                           FinancialLibrary::detectSimdLevel() == FinancialLibrary::SimdLevel::AVX2 ? "avx2" : "generic");
+        std::printf("  },\n  \"benchmarks\": [\n");
+        for (size_t i = 0; i < results.size(); ++i) {
+            const BenchmarkResult& r = results[i];
+            std::printf("    {\n      \"name\": \"%s\",\n      \"run_type\": \"iteration\",\n", r.name.c_str());
+            std::printf("      \"iterations\": %llu,\n", r.iterations);
+            std::printf("      \"real_time\": %.3f,\n      \"cpu_time\": %.3f,\n      \"time_unit\": \"ns\"", r.ns_per_op, r.ns_per_op);
+            if (r.solver_iterations >= 0) {
+                std::printf(",\n      \"solver_iterations\": %.2f", r.solver_iterations);
+            }
+            std::printf("\n    }%s\n", i + 1 == results.size() ? "" : ",");
+        }
+        std::printf("  ]\n}\n");
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bool json = false;
+    double min_seconds = 0.1;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (std::strncmp(argv[i], "--min-time=", 11) == 0) {
+            min_seconds = std::atof(argv[i] + 11);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--json] [--min-time=SECONDS]\n";
+            return 1;
+        }
+    }
+
+    using namespace FinancialLibrary;
+    std::vector<BenchmarkResult> results;
+
+    // Vary the inputs per call so the compiler cannot hoist the work out of the loop
+    results.push_back(runBenchmark("calculateFutureValue", min_seconds, [](unsigned long long i) {
+        return calculateFutureValue(1000.0, 0.05 + 1e-9 * double(i & 1023), 10 + int(i & 15));
+    }));
+    results.push_back(runBenchmark("calculatePresentValue", min_seconds, [](unsigned long long i) {
+        return calculatePresentValue(2000.0, 0.08 + 1e-9 * double(i & 1023), 5 + int(i & 15));
+    }));
+
+    static const size_t lengths[] = {4, 16, 64, 256, 1024, 4096, 10000};
+    const size_t length_count = sizeof(lengths) / sizeof(lengths[0]);
+
+    for (size_t k = 0; k < length_count; ++k) {
+        const std::vector<double> cash_flows = conventionalCashFlows(lengths[k]);
+        results.push_back(runBenchmark("calculateNetPresentValue/" + std::to_string(lengths[k]), min_seconds,
+                                       [&cash_flows](unsigned long long i) {
+            return calculateNetPresentValue(0.1 + 1e-9 * double(i & 1023), cash_flows);
+        }));
+    }
+
+    for (size_t k = 0; k < length_count; ++k) {
+        const std::vector<double> wide = conventionalCashFlows(lengths[k]);
+        const std::vector<float> cash_flows(wide.begin(), wide.end());
+        std::vector<Money> amounts;
+        for (size_t t = 0; t < wide.size(); ++t) amounts.push_back(Money::fromDouble(wide[t]));
+        results.push_back(runBenchmark("calculateNetPresentValue/float/" + std::to_string(lengths[k]), min_seconds,
+                                       [&cash_flows](unsigned long long i) {
+            return double(tryCalculateNetPresentValue(0.1 + 1e-9 * double(i & 1023), cash_flows).value());
+        }));
+        results.push_back(runBenchmark("calculateNetPresentValue/Money/" + std::to_string(lengths[k]), min_seconds,
+                                       [&amounts](unsigned long long i) {
+            return tryCalculateNetPresentValue(0.1 + 1e-9 * double(i & 1023), amounts).value().toDouble();
+        }));
+    }
+
+    for (size_t k = 0; k < length_count; ++k) {
+        const std::vector<double> cash_flows = conventionalCashFlows(lengths[k]);
+        const YieldCurve curve({0.0, 12.0, 60.0, 360.0}, {0.02, 0.03, 0.045, 0.05}, lengths[k]);
+        results.push_back(runBenchmark("calculateNetPresentValue/YieldCurve/" + std::to_string(lengths[k]), min_seconds,
+                                       [&cash_flows, &curve](unsigned long long i) {
+            return calculateNetPresentValue(curve, cash_flows) + 1e-9 * double(i & 1023);
+        }));
+    }
+
+    for (size_t k = 0; k < length_count; ++k) {
+        const std::vector<double> cash_flows = conventionalCashFlows(lengths[k]);
+        results.push_back(runBenchmark("calculateRateSensitivity/" + std::to_string(lengths[k]), min_seconds,
+                                       [&cash_flows](unsigned long long i) {
+            return calculateRateSensitivity(0.1 + 1e-9 * double(i & 1023), cash_flows).dv01;
+        }));
+    }
+
+    {
+        // 500 parallel shocks of +/-250bp x 256 instruments x 360 periods, the shape of a stress run
+        std::vector<std::vector<double> > series(256);
+        for (size_t j = 0; j < series.size(); ++j) series[j] = conventionalCashFlows(360);
+        const CashFlowMatrix matrix = CashFlowMatrix::fromSeries(series);
+        std::vector<double> shocks(500);
+        for (size_t s = 0; s < shocks.size(); ++s) shocks[s] = -0.025 + 0.0001 * double(s);
+        const ScenarioGrid grid = ScenarioGrid::parallelShifts(0.05, shocks, 360);
+        std::vector<double> npvs(grid.scenarios() * matrix.instruments());
+        results.push_back(runBenchmark("calculateNetPresentValueScenarios/500x256x360", min_seconds,
+                                       [&grid, &matrix, &npvs](unsigned long long) {
+            calculateNetPresentValueScenarios(grid, matrix, npvs.data());
+            return npvs[0];
+        }));
+    }
+
+    {
+        const std::vector<double> cash_flows = conventionalCashFlows(120);
+        const ShortRateModel model = ShortRateModel::vasicek(0.004, 0.02, 0.005, 0.0005, 120);
+        MonteCarloOptions options;
+        options.paths = 10000;
+        results.push_back(runBenchmark("simulateNetPresentValue/Vasicek/10000x120", min_seconds,
+                                       [&cash_flows, &model, &options](unsigned long long i) {
+            options.seed = i;
+            return simulateNetPresentValue(model, cash_flows, options).mean;
+        }));
+    }
+
+    {
+        // A level 30-year monthly mortgage: one outflow, then 360 equal payments
+        std::vector<double> cash_flows(361, 1798.65);
+        cash_flows[0] = -300000.0;
+        results.push_back(runBenchmark("calculateNetPresentValue/level_mortgage/361", min_seconds, [&cash_flows](unsigned long long i) {
+            return calculateNetPresentValue(0.005 + 1e-9 * double(i & 1023), cash_flows);
+        }));
+        results.push_back(runBenchmark("calculateNetPresentValueCollapsingRuns/level_mortgage/361", min_seconds, [&cash_flows](unsigned long long i) {
+            return calculateNetPresentValueCollapsingRuns(0.005 + 1e-9 * double(i & 1023), cash_flows);
+        }));
+        const std::vector<CashFlowRun> runs = compressCashFlowRuns(cash_flows);
+        results.push_back(runBenchmark("calculateNetPresentValue/CashFlowRun/level_mortgage/361", min_seconds, [&runs](unsigned long long i) {
+            return calculateNetPresentValue(0.005 + 1e-9 * double(i & 1023), runs);
+        }));
+    }
+
+    {
+        // Daily compounding over a book of 4096 deposits with spread rates and tenors
+        const size_t deposits = 4096;
+        std::vector<double> principals(deposits, 1000.0), rates(deposits), times(deposits), amounts(deposits);
+        for (size_t j = 0; j < deposits; ++j) {
+            rates[j] = 0.0001 * double(j % 1000);
+            times[j] = 0.01 * double(j % 3000);
+        }
+        results.push_back(runBenchmark("calculateCompoundInterest/daily/4096", min_seconds, [&principals, &rates, &times, &amounts, deposits](unsigned long long) {
+            for (size_t j = 0; j < deposits; ++j) amounts[j] = calculateCompoundInterest(principals[j], rates[j], 365, times[j]);
+            return amounts[deposits - 1];
+        }));
+        results.push_back(runBenchmark("calculateCompoundInterestBatch/daily/4096", min_seconds, [&principals, &rates, &times, &amounts, deposits](unsigned long long) {
+            calculateCompoundInterestBatch(principals.data(), rates.data(), times.data(), deposits, 365, amounts.data());
+            return amounts[deposits - 1];
+        }));
+    }
+
+    {
+        // 20 years of monthly private-equity style flows on irregular days, one table for all solves
+        std::vector<Date> dates;
+        std::vector<double> cash_flows;
+        for (int k = 0; k < 240; ++k) {
+            const Date date = {2000 + k / 12, 1 + k % 12, 1 + (k * 7) % 28};
+            dates.push_back(date);
+            cash_flows.push_back(k < 12 ? -5000.0 : 600.0);
+        }
+        const YearFractionTable fractions(dates, DayCount::ActualActual);
+        results.push_back(runBenchmark("calculateNetPresentValue/YearFractionTable/240", min_seconds, [&fractions, &cash_flows](unsigned long long i) {
+            return calculateNetPresentValue(0.1 + 1e-9 * double(i & 1023), fractions, cash_flows);
+        }));
+        results.push_back(runBenchmark("calculateInternalRateOfReturn/YearFractionTable/240", min_seconds, [&fractions, &cash_flows](unsigned long long i) {
+            return calculateInternalRateOfReturn(fractions, cash_flows, 0.1 + 1e-9 * double(i & 1023));
+        }));
+    }
+
+    struct IrrCase {
+        const char* name;
+        std::vector<double> (*make)(size_t);
+    };
+    static const IrrCase irr_cases[] = {
+        {"conventional", conventionalCashFlows},
+        {"slow_convergence", slowConvergenceCashFlows},
+        {"multiple_sign_changes", multipleSignChangeCashFlows},
+        {"distant_root", distantRootCashFlows},
+    };
+    for (size_t c = 0; c < sizeof(irr_cases) / sizeof(irr_cases[0]); ++c) {
+        for (size_t k = 0; k < length_count; ++k) {
+            const std::vector<double> cash_flows = irr_cases[c].make(lengths[k]);
+            // try* variant: unsolvable pathological inputs would otherwise write to std::cerr on every call
+            const double evaluations = double(trySolveInternalRateOfReturn(cash_flows).value().iterations);
+            results.push_back(runBenchmark(std::string("calculateInternalRateOfReturn/") + irr_cases[c].name + "/" + std::to_string(lengths[k]),
+                                           min_seconds, [&cash_flows](unsigned long long) {
+                return tryCalculateInternalRateOfReturn(cash_flows).valueOr(0.0);
+            }, evaluations));
+        }
+    }
+
+    for (size_t k = 0; k < length_count; ++k) {
+        const std::vector<double> cash_flows = conventionalCashFlows(lengths[k]);
+        const double evaluations = double(trySolveInternalRateOfReturnMixedPrecision(cash_flows).value().iterations);
+        results.push_back(runBenchmark("calculateInternalRateOfReturnMixedPrecision/conventional/" + std::to_string(lengths[k]),
+                                       min_seconds, [&cash_flows](unsigned long long) {
+            return tryCalculateInternalRateOfReturnMixedPrecision(cash_flows).valueOr(0.0);
+        }, evaluations));
+    }
+
+    for (size_t k = 0; k < length_count; ++k) {
+        const std::vector<double> cash_flows = multipleSignChangeCashFlows(lengths[k]);
+        const double evaluations = double(tryFindInternalRatesOfReturn(cash_flows).value().iterations);
+        results.push_back(runBenchmark("findInternalRatesOfReturn/multiple_sign_changes/" + std::to_string(lengths[k]),
+                                       min_seconds, [&cash_flows](unsigned long long) {
+            return double(tryFindInternalRatesOfReturn(cash_flows).value().irrs.size());
+        }, evaluations));
+        results.push_back(runBenchmark("calculateModifiedInternalRateOfReturn/multiple_sign_changes/" + std::to_string(lengths[k]),
+                                       min_seconds, [&cash_flows](unsigned long long i) {
+            return tryCalculateModifiedInternalRateOfReturn(cash_flows, 0.08 + 1e-9 * double(i & 1023), 0.1).valueOr(0.0);
+        }));
+    }
+
+    {
+        // Unchanged instruments re-run against a warm cache: compare with calculateInternalRateOfReturn/conventional/N
+        ResultCache cache;
+        for (size_t k = 0; k < length_count; ++k) {
+            const std::vector<double> cash_flows = conventionalCashFlows(lengths[k]);
+            cache.tryCalculateInternalRateOfReturn(cash_flows);
+            results.push_back(runBenchmark("ResultCache::calculateInternalRateOfReturn/hit/" + std::to_string(lengths[k]),
+                                           min_seconds, [&cache, &cash_flows](unsigned long long) {
+                return cache.tryCalculateInternalRateOfReturn(cash_flows).valueOr(0.0);
+            }));
+        }
+    }
+
+    if (json) {
+        printJson(results, min_seconds);
+    } else {
+        printTable(results);
+    }
+    return 0;
+}